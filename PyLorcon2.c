@@ -23,7 +23,18 @@
 
 
 #include <Python.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <lorcon2/lorcon.h>
+
+#define PYLORCON2_MODULE
 #include "PyLorcon2.h"
 
 
@@ -166,6 +177,198 @@ PyLorcon2_lorcon_loop(PyLorcon2_Context *context, PyObject *args) {
 	return 1;
 }
 
+/*
+    ###########################################################################
+    
+    Shared-memory ring helpers
+    
+    ###########################################################################
+*/
+
+#define RING_ALIGN_UP(x) \
+    (((uint64_t)(x) + PYLORCON2_RING_ALIGN - 1) & ~(uint64_t)(PYLORCON2_RING_ALIGN - 1))
+
+#define RING_POLL_MIN_NSEC  50000       /* idle readers back off from here... */
+#define RING_POLL_MAX_NSEC  2000000     /* ...to here */
+#define RING_SLICE_NSEC     100000000   /* reader re-checks signals this often */
+
+#define RING_MAX_OFFSET \
+    (((uint64_t)1 << (sizeof(off_t) * 8 - 1)) - 1)
+
+static PyTypeObject PyLorcon2_RingType;
+
+/* Nanoseconds from a to b */
+static long long
+timespec_elapsed(const struct timespec *a, const struct timespec *b)
+{
+    return (b->tv_sec - a->tv_sec) * 1000000000LL + (b->tv_nsec - a->tv_nsec);
+}
+
+static void
+timespec_advance(struct timespec *ts, long long nsec)
+{
+    ts->tv_sec += nsec / 1000000000;
+    ts->tv_nsec += nsec % 1000000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+/* Slot stride for a snaplen; snaplen must not exceed PYLORCON2_RING_MAX_SNAPLEN */
+static uint32_t
+ring_stride(uint32_t snaplen)
+{
+    return (uint32_t)RING_ALIGN_UP(sizeof(PyLorcon2_RingSlot) + (uint64_t)snaplen);
+}
+
+/* Total segment size into *size; -1 if it overflows or can't be mapped */
+static int
+ring_size(uint32_t consumers, uint32_t slots, uint32_t stride, uint64_t *size)
+{
+    uint64_t slot_bytes, total;
+
+    if (__builtin_mul_overflow((uint64_t)consumers, (uint64_t)slots, &slot_bytes) ||
+        __builtin_mul_overflow(slot_bytes, (uint64_t)stride, &slot_bytes) ||
+        __builtin_add_overflow(slot_bytes,
+                               RING_ALIGN_UP(sizeof(PyLorcon2_RingHeader)) +
+                               (uint64_t)consumers * sizeof(PyLorcon2_RingLane), &total) ||
+        total > RING_MAX_OFFSET || total > (uint64_t)SIZE_MAX)
+        return -1;
+
+    *size = total;
+    return 0;
+}
+
+/* A ring whose producer died without closing it counts as closed */
+static int
+ring_producer_gone(PyLorcon2_RingHeader *header)
+{
+    int32_t pid = __atomic_load_n(&header->producer, __ATOMIC_ACQUIRE);
+    char path[32], stat[64], *state;
+    ssize_t n;
+    int fd;
+
+    if (pid == 0)
+        return 0;
+
+    if (kill(pid, 0) < 0)
+        return errno == ESRCH;
+
+    /* An exited producer nobody has reaped yet still answers kill() */
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    n = read(fd, stat, sizeof(stat) - 1);
+    close(fd);
+    if (n <= 0)
+        return 0;
+    stat[n] = '\0';
+
+    state = strrchr(stat, ')');
+    return state != NULL && state[1] == ' ' && state[2] == 'Z';
+}
+
+static PyLorcon2_RingLane*
+ring_lane(PyLorcon2_RingHeader *header, uint32_t consumer)
+{
+    PyLorcon2_RingLane *lanes;
+
+    lanes = (PyLorcon2_RingLane*)((char*)header + RING_ALIGN_UP(sizeof(*header)));
+    return &lanes[consumer];
+}
+
+static PyLorcon2_RingSlot*
+ring_slot(PyLorcon2_RingHeader *header, uint32_t consumer, uint64_t seq)
+{
+    char *base;
+
+    base = (char*)ring_lane(header, header->consumers);
+    base += ((uint64_t)consumer * header->slots + (seq & (header->slots - 1))) * header->stride;
+    return (PyLorcon2_RingSlot*)base;
+}
+
+/* Map the whole segment behind an open shm descriptor, or NULL on error */
+static PyLorcon2_RingHeader*
+ring_map(int fd, uint64_t size)
+{
+    void *addr;
+
+    addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return addr == MAP_FAILED ? NULL : (PyLorcon2_RingHeader*)addr;
+}
+
+/* Choose the lane for a frame; frames without an addr2 go to lane 0 */
+static uint32_t
+ring_pick_lane(PyLorcon2_Ring *ring, lorcon_packet_t *packet)
+{
+    PyLorcon2_RingHeader *header = ring->header;
+    const u_char *addr2;
+    uint32_t hash;
+    int i;
+
+    if (header->consumers == 1)
+        return 0;
+
+    if (header->mode == PYLORCON2_FANOUT_RR)
+        return ring->next++ % header->consumers;
+
+    if (packet->packet_header == NULL || packet->length_header < 16)
+        return 0;
+
+    /* FNV-1a over the transmitter address */
+    addr2 = packet->packet_header + 10;
+    hash = 2166136261U;
+    for (i = 0; i < 6; i++) {
+        hash ^= addr2[i];
+        hash *= 16777619U;
+    }
+    /* Fold the high bits in; FNV leaves the low ones poorly mixed */
+    hash ^= hash >> 16;
+
+    return hash % header->consumers;
+}
+
+/* lorcon_loop() handler; runs without the GIL */
+static void
+ring_push(lorcon_t *context, lorcon_packet_t *packet, u_char *user)
+{
+    PyLorcon2_Ring *ring = (PyLorcon2_Ring*)user;
+    PyLorcon2_RingHeader *header = ring->header;
+    PyLorcon2_RingLane *lane;
+    PyLorcon2_RingSlot *slot;
+    uint64_t head, tail;
+    uint32_t caplen;
+
+    ring->captured++;
+
+    if (packet->packet_raw == NULL || packet->length <= 0)
+        return;
+
+    lane = ring_lane(header, ring_pick_lane(ring, packet));
+    head = lane->head;
+    tail = __atomic_load_n(&lane->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= header->slots) {
+        __atomic_store_n(&lane->drops, lane->drops + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    caplen = (uint32_t)packet->length;
+    if (caplen > header->snaplen)
+        caplen = header->snaplen;
+
+    slot = ring_slot(header, (uint32_t)(lane - ring_lane(header, 0)), head);
+    slot->length = (uint32_t)packet->length;
+    slot->caplen = caplen;
+    slot->tv_sec = packet->ts.tv_sec;
+    slot->tv_usec = packet->ts.tv_usec;
+    slot->channel = packet->channel;
+    memcpy(slot->data, packet->packet_raw, caplen);
+
+    __atomic_store_n(&lane->head, head + 1, __ATOMIC_RELEASE);
+}
+
 /*
     ###########################################################################
     
@@ -208,6 +411,11 @@ PyLorcon2_Context_init(PyLorcon2_Context *self, PyObject *args, PyObject *kwds)
     }
     
     self->monitored = 0;
+    self->capturing = 0;
+    self->sending = 0;
+    self->closing = 0;
+    self->handler = NULL;
+    self->handler_user = NULL;
     lorcon_set_timeout(self->context, 100);
 
     return 0;
@@ -278,9 +486,29 @@ PyDoc_STRVAR(PyLorcon2_Context_close__doc__,
 static PyObject*
 PyLorcon2_Context_close(PyLorcon2_Context *self)
 {
+    if (self->capturing) {
+        PyErr_SetString(PyExc_RuntimeError, "Context is capturing; call breakloop() first");
+        return NULL;
+    }
+
+    /*
+        Context_SendBytes() may run without the GIL: it bumps `sending`
+        before looking at `closing`, and we raise `closing` before looking
+        at `sending`, so one side always sees the other. Senders that see
+        `closing` wait for us to finish, so a refused close() never makes
+        them fail.
+    */
+    __atomic_store_n(&self->closing, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&self->sending, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(&self->closing, 0, __ATOMIC_RELEASE);
+        PyErr_SetString(PyExc_RuntimeError, "Context is injecting");
+        return NULL;
+    }
+
     lorcon_close(self->context);
-    
+
     self->monitored = 0;
+    __atomic_store_n(&self->closing, 0, __ATOMIC_RELEASE);
 
     Py_INCREF(Py_None);
     return Py_None;
@@ -549,123 +777,1570 @@ PyLorcon2_Context_set_hwmac(PyLorcon2_Context *self, PyObject *args, PyObject *k
     return Py_None;
 }
 
-/*
-    ###########################################################################
-    
-    Definitions
-    
-    ###########################################################################
-*/
 
-static PyMethodDef PyLorcon2Methods[] =
+PyDoc_STRVAR(PyLorcon2_Context_fanout__doc__, 
+    "fanout(Ring[, count]) -> integer\n\n"
+    "Capture count frames (forever if count <= 0) into the given Ring,\n"
+    "without holding the GIL. Return the number of frames captured");
+
+static PyObject*
+PyLorcon2_Context_fanout(PyLorcon2_Context *self, PyObject *args, PyObject *kwds)
 {
-    {"get_version",  PyLorcon2_get_version,  METH_NOARGS,  PyLorcon2_get_version__doc__},
-    {"list_drivers", PyLorcon2_list_drivers, METH_NOARGS,  PyLorcon2_list_drivers__doc__},
-    {"find_driver",  PyLorcon2_find_driver,  METH_VARARGS, PyLorcon2_find_driver__doc__},
-    {"auto_driver",  PyLorcon2_auto_driver,  METH_VARARGS, PyLorcon2_auto_driver__doc__},
-    {"lorcon_loop", PyLorcon2_lorcon_loop, METH_VARARGS, PyLorcon2_lorcon_loop__doc__},
-    {NULL, NULL, 0, NULL}
-};
+    static char *kwlist[] = {"ring", "count", NULL};
+    PyLorcon2_Ring *ring;
+    int count = -1, r;
 
-static PyMethodDef PyLorcon2_Context_Methods[] =
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|i", kwlist,
+                                     &PyLorcon2_RingType, &ring, &count))
+        return NULL;
+
+    if (!self->monitored) {
+        PyErr_SetString(PyExc_RuntimeError, "Context must be in monitor/injection-mode");
+        return NULL;
+    }
+
+    if (ring->header == NULL) {
+        PyErr_SetString(PyExc_ValueError, "Ring is closed");
+        return NULL;
+    }
+
+    if (ring->capturing) {
+        PyErr_SetString(PyExc_RuntimeError, "Ring is already being filled");
+        return NULL;
+    }
+
+    if (self->capturing) {
+        PyErr_SetString(PyExc_RuntimeError, "Context is already capturing");
+        return NULL;
+    }
+
+    Py_INCREF(ring);
+    ring->capturing = 1;
+    ring->captured = 0;
+    self->capturing = 1;
+    /* Readers watch this process for liveness, not whoever created the ring */
+    __atomic_store_n(&ring->header->producer, (int32_t)getpid(), __ATOMIC_RELEASE);
+
+    Py_BEGIN_ALLOW_THREADS
+    r = lorcon_loop(self->context, count, ring_push, (u_char*)ring);
+    Py_END_ALLOW_THREADS
+
+    self->capturing = 0;
+    ring->capturing = 0;
+    Py_DECREF(ring);
+
+    /* -2 is a breakloop() stop; anything else negative is a failure */
+    if (r < 0 && r != -2) {
+        PyErr_SetString(Lorcon2Exception, lorcon_get_error(self->context));
+        return NULL;
+    }
+
+    return PyLong_FromUnsignedLongLong(ring->captured);
+}
+
+
+PyDoc_STRVAR(PyLorcon2_Context_loop__doc__, 
+    "loop([count]) -> None\n\n"
+    "Capture count packets (forever if count <= 0), without holding the GIL,\n"
+    "passing each to the native handler registered through the C API");
+
+static PyObject*
+PyLorcon2_Context_loop(PyLorcon2_Context *self, PyObject *args, PyObject *kwds)
 {
-    {"open_inject",     (PyCFunction)PyLorcon2_Context_open_inject,     METH_NOARGS,  PyLorcon2_Context_open_inject__doc__},
-    {"open_monitor",    (PyCFunction)PyLorcon2_Context_open_monitor,    METH_NOARGS,  PyLorcon2_Context_open_monitor__doc__},
-    {"open_injmon",     (PyCFunction)PyLorcon2_Context_open_injmon,     METH_NOARGS,  PyLorcon2_Context_open_injmon__doc__},
-    {"close",           (PyCFunction)PyLorcon2_Context_close,           METH_NOARGS,  PyLorcon2_Context_close__doc__},
-    {"get_error",       (PyCFunction)PyLorcon2_Context_get_error,       METH_NOARGS,  PyLorcon2_Context_get_error__doc__},
-    {"get_capiface",    (PyCFunction)PyLorcon2_Context_get_capiface,    METH_NOARGS,  PyLorcon2_Context_get_capiface__doc__},
-    {"send_bytes",      (PyCFunction)PyLorcon2_Context_send_bytes,      METH_VARARGS, PyLorcon2_Context_send_bytes__doc__},
-    {"set_timeout",     (PyCFunction)PyLorcon2_Context_set_timeout,
-                        METH_VARARGS | METH_KEYWORDS, PyLorcon2_Context_set_timeout__doc__},
-    {"get_timeout",     (PyCFunction)PyLorcon2_Context_get_timeout,     METH_NOARGS,  PyLorcon2_Context_get_timeout__doc__},
-    {"set_vap",         (PyCFunction)PyLorcon2_Context_set_vap,
-                        METH_VARARGS | METH_KEYWORDS, PyLorcon2_Context_set_vap__doc__},
-    {"get_vap",         (PyCFunction)PyLorcon2_Context_get_vap,         METH_NOARGS,  PyLorcon2_Context_get_vap__doc__},
-    {"get_driver_name", (PyCFunction)PyLorcon2_Context_get_driver_name, METH_NOARGS,  PyLorcon2_Context_get_driver_name__doc__},
-    {"set_channel",     (PyCFunction)PyLorcon2_Context_set_channel,     METH_VARARGS, PyLorcon2_Context_set_channel__doc__},
-    {"get_channel",     (PyCFunction)PyLorcon2_Context_get_channel,     METH_NOARGS,  PyLorcon2_Context_get_channel__doc__},
-    {"set_hwmac",       (PyCFunction)PyLorcon2_Context_set_hwmac,       METH_VARARGS, PyLorcon2_Context_set_hwmac__doc__},
-    {"get_hwmac",       (PyCFunction)PyLorcon2_Context_get_hwmac,       METH_NOARGS,  PyLorcon2_Context_get_hwmac__doc__},
-    {NULL, NULL, 0, NULL}
-};
+    static char *kwlist[] = {"count", NULL};
+    int count = -1, r;
 
-static PyTypeObject PyLorcon2_ContextType = {
-    PyObject_HEAD_INIT(NULL)
-    0,                                        /* ob_size */
-    "PyLorcon2.Context",                      /* tp_name */
-    sizeof(PyLorcon2_Context),                /* tp_basic_size */
-    0,                                        /* tp_itemsize */
-    (destructor)PyLorcon2_Context_dealloc,    /* tp_dealloc */
-    0,                                        /* tp_print */
-    0,                                        /* tp_getattr */
-    0,                                        /* tp_setattr */
-    0,                                        /* tp_compare */
-    0,                                        /* tp_repr */
-    0,                                        /* tp_as_number */
-    0,                                        /* tp_as_sequence */
-    0,                                        /* tp_as_mapping */
-    0,                                        /* tp_hash */
-    0,                                        /* tp_call */
-    0,                                        /* tp_str */
-    0,                                        /* tp_getattro */
-    0,                                        /* tp_setattro */
-    0,                                        /* tp_as_buffer */
-    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
-    "PyLorcon2 Context Object",               /* tp_doc */
-    0,                                        /* tp_traverse */
-    0,                                        /* tp_clear */
-    0,                                        /* tp_richcompare */
-    0,                                        /* tp_weaklistoffset */
-    0,                                        /* tp_iter */
-    0,                                        /* tp_iternext */
-    PyLorcon2_Context_Methods,                /* tp_methods */
-    0,                                        /* tp_members */
-    0,                                        /* tp_getset */
-    0,                                        /* tp_base */
-    0,                                        /* tp_dict */
-    0,                                        /* tp_descr_get */
-    0,                                        /* tp_descr_set */
-    0,                                        /* tp_dictoffset */
-    (initproc)PyLorcon2_Context_init,         /* tp_init */
-    0,                                        /* tp_alloc */
-    0,                                        /* tp_new */
-};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &count))
+        return NULL;
+
+    if (!self->monitored) {
+        PyErr_SetString(PyExc_RuntimeError, "Context must be in monitor/injection-mode");
+        return NULL;
+    }
+
+    if (self->handler == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "No native packet handler registered");
+        return NULL;
+    }
+
+    if (self->capturing) {
+        PyErr_SetString(PyExc_RuntimeError, "Context is already capturing");
+        return NULL;
+    }
+
+    /* Context_SetHandler() refuses to swap the handler until we are done */
+    self->capturing = 1;
+
+    Py_BEGIN_ALLOW_THREADS
+    r = lorcon_loop(self->context, count, self->handler, (u_char*)self->handler_user);
+    Py_END_ALLOW_THREADS
+
+    self->capturing = 0;
+
+    /* -2 is a breakloop() stop; anything else negative is a failure */
+    if (r < 0 && r != -2) {
+        PyErr_SetString(Lorcon2Exception, lorcon_get_error(self->context));
+        return NULL;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
 
 
+PyDoc_STRVAR(PyLorcon2_Context_breakloop__doc__, 
+    "breakloop() -> None\n\n"
+    "Make a capture loop running in another thread return");
+
+static PyObject*
+PyLorcon2_Context_breakloop(PyLorcon2_Context *self)
+{
+    lorcon_breakloop(self->context);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 /*
     ###########################################################################
     
-    Module initialization
+    Class Ring
     
     ###########################################################################
 */
 
-PyMODINIT_FUNC
-initPyLorcon2(void)
+static void
+PyLorcon2_Ring_release(PyLorcon2_Ring *self)
 {
-    PyObject *m;
+    if (self->header != NULL) {
+        __atomic_store_n(&self->header->closed, 1, __ATOMIC_RELEASE);
+        munmap(self->header, self->header->size);
+        self->header = NULL;
+    }
 
-    if(PyType_Ready(&PyLorcon2_ContextType) < 0)
-        return;
+    if (self->name != NULL) {
+        shm_unlink(self->name);
+        PyMem_Free(self->name);
+        self->name = NULL;
+    }
+}
 
-    m = Py_InitModule3("PyLorcon2", PyLorcon2Methods, "Wrapper for the Lorcon2 library");
+static void
+PyLorcon2_Ring_dealloc(PyLorcon2_Ring *self)
+{
+    PyLorcon2_Ring_release(self);
+    self->ob_type->tp_free((PyObject*)self);
+}
 
-    if(m == NULL)
-        return;
+static int
+PyLorcon2_Ring_init(PyLorcon2_Ring *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"name", "consumers", "slots", "snaplen", "mode", NULL};
+    PyLorcon2_RingHeader *header;
+    unsigned int consumers, slots = 1024, snaplen = 4096, mode = PYLORCON2_FANOUT_HASH;
+    uint32_t stride;
+    uint64_t size;
+    char *name;
+    int fd;
 
-    /* Lorcon2 Exception */
-    Lorcon2Exception = PyErr_NewException("PyLorcon2.Lorcon2Exception", NULL, NULL);
-    Py_INCREF(Lorcon2Exception);
-    PyModule_AddObject(m, "Lorcon2Exception", Lorcon2Exception);
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sI|III", kwlist,
+                                     &name, &consumers, &slots, &snaplen, &mode))
+        return -1;
 
-    /* Lorcon2 Context Object */
-    Py_INCREF(&PyLorcon2_ContextType);
-    PyLorcon2_ContextType.tp_getattro = PyObject_GenericGetAttr;
-    PyLorcon2_ContextType.tp_setattro = PyObject_GenericSetAttr;
-    PyLorcon2_ContextType.tp_alloc  = PyType_GenericAlloc;
-    PyLorcon2_ContextType.tp_new = PyType_GenericNew;
-    PyLorcon2_ContextType.tp_free = _PyObject_Del;
-    PyModule_AddObject(m, "Context", (PyObject*)&PyLorcon2_ContextType);
+    if (self->header != NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Ring is already initialized");
+        return -1;
+    }
+
+    if (consumers == 0 || slots == 0 || (slots & (slots - 1)) != 0 || snaplen == 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "consumers and snaplen must be positive, slots a power of two");
+        return -1;
+    }
+
+    if (snaplen > PYLORCON2_RING_MAX_SNAPLEN) {
+        PyErr_Format(PyExc_ValueError, "snaplen must be at most %d",
+                     PYLORCON2_RING_MAX_SNAPLEN);
+        return -1;
+    }
+
+    if (mode != PYLORCON2_FANOUT_HASH && mode != PYLORCON2_FANOUT_RR) {
+        PyErr_SetString(PyExc_ValueError, "mode must be FANOUT_HASH or FANOUT_RR");
+        return -1;
+    }
+
+    stride = ring_stride(snaplen);
+    if (ring_size(consumers, slots, stride, &size) < 0) {
+        PyErr_SetString(PyExc_ValueError, "Ring is too large for consumers * slots * snaplen");
+        return -1;
+    }
+
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, name);
+        return -1;
+    }
+
+    if (ftruncate(fd, (off_t)size) < 0 || (header = ring_map(fd, size)) == NULL) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, name);
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    close(fd);
+
+    self->name = PyMem_Malloc(strlen(name) + 1);
+    if (self->name == NULL) {
+        munmap(header, size);
+        shm_unlink(name);
+        PyErr_NoMemory();
+        return -1;
+    }
+    strcpy(self->name, name);
+
+    header->version = PYLORCON2_RING_VERSION;
+    header->consumers = consumers;
+    header->slots = slots;
+    header->snaplen = snaplen;
+    header->stride = stride;
+    header->mode = mode;
+    header->size = size;
+    header->producer = (int32_t)getpid();
+    /* Readers refuse to attach until the magic is visible */
+    __atomic_store_n(&header->magic, PYLORCON2_RING_MAGIC, __ATOMIC_RELEASE);
+
+    self->header = header;
+    self->next = 0;
+
+    return 0;
+}
+
+
+PyDoc_STRVAR(PyLorcon2_Ring_close__doc__, 
+    "close() -> None\n\n"
+    "Mark the ring as finished and remove it; attached readers drain what\n"
+    "is left and then stop");
+
+static PyObject*
+PyLorcon2_Ring_close(PyLorcon2_Ring *self)
+{
+    if (self->capturing) {
+        PyErr_SetString(PyExc_RuntimeError, "Ring is being filled");
+        return NULL;
+    }
+
+    PyLorcon2_Ring_release(self);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
+PyDoc_STRVAR(PyLorcon2_Ring_stats__doc__, 
+    "stats() -> list\n\n"
+    "Return a (frames, drops, pending) tuple for every consumer");
+
+static PyObject*
+PyLorcon2_Ring_stats(PyLorcon2_Ring *self)
+{
+    PyObject *retval, *entry;
+    PyLorcon2_RingLane *lane;
+    uint64_t head, tail;
+    uint32_t i;
+
+    if (self->header == NULL) {
+        PyErr_SetString(PyExc_ValueError, "Ring is closed");
+        return NULL;
+    }
+
+    retval = PyList_New(self->header->consumers);
+    if (!retval)
+        return NULL;
+
+    for (i = 0; i < self->header->consumers; i++) {
+        lane = ring_lane(self->header, i);
+        head = __atomic_load_n(&lane->head, __ATOMIC_ACQUIRE);
+        tail = __atomic_load_n(&lane->tail, __ATOMIC_ACQUIRE);
+        entry = Py_BuildValue("(KKK)", (unsigned long long)head,
+                              (unsigned long long)lane->drops,
+                              (unsigned long long)(head - tail));
+        if (!entry) {
+            Py_DECREF(retval);
+            return NULL;
+        }
+        PyList_SET_ITEM(retval, i, entry);
+    }
+
+    return retval;
+}
+
+/*
+    ###########################################################################
+    
+    Class RingReader
+    
+    ###########################################################################
+*/
+
+static void
+PyLorcon2_RingReader_release(PyLorcon2_RingReader *self)
+{
+    int32_t pid;
+
+    if (self->header != NULL) {
+        /* Only give the lane up if this process is the one holding it */
+        pid = (int32_t)getpid();
+        __atomic_compare_exchange_n(&ring_lane(self->header, self->consumer)->reader,
+                                    &pid, 0, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        munmap(self->header, self->header->size);
+        self->header = NULL;
+    }
+}
+
+static void
+PyLorcon2_RingReader_dealloc(PyLorcon2_RingReader *self)
+{
+    PyLorcon2_RingReader_release(self);
+    self->ob_type->tp_free((PyObject*)self);
+}
+
+/* Claim a lane for this process; a claim left by a dead process is taken over */
+static int
+ring_claim_lane(PyLorcon2_RingLane *lane)
+{
+    int32_t owner, pid = (int32_t)getpid();
+
+    owner = __atomic_load_n(&lane->reader, __ATOMIC_ACQUIRE);
+    for (;;) {
+        if (owner != 0 && (owner == pid || kill(owner, 0) == 0 || errno != ESRCH))
+            return -1;
+        if (__atomic_compare_exchange_n(&lane->reader, &owner, pid, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return 0;
+    }
+}
+
+static int
+PyLorcon2_RingReader_init(PyLorcon2_RingReader *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"name", "consumer", NULL};
+    PyLorcon2_RingHeader *header;
+    unsigned int consumer;
+    struct stat st;
+    uint64_t size;
+    char *name;
+    int fd;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sI", kwlist, &name, &consumer))
+        return -1;
+
+    if (self->header != NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RingReader is already attached");
+        return -1;
+    }
+
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, name);
+        return -1;
+    }
+
+    if (fstat(fd, &st) < 0 || (header = ring_map(fd, (uint64_t)st.st_size)) == NULL) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, name);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    /* Never trust the geometry of a segment someone else wrote */
+    if ((uint64_t)st.st_size < sizeof(PyLorcon2_RingHeader) ||
+        __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != PYLORCON2_RING_MAGIC ||
+        header->version != PYLORCON2_RING_VERSION ||
+        header->snaplen == 0 || header->snaplen > PYLORCON2_RING_MAX_SNAPLEN ||
+        header->stride != ring_stride(header->snaplen) ||
+        header->slots == 0 || (header->slots & (header->slots - 1)) != 0 ||
+        ring_size(header->consumers, header->slots, header->stride, &size) < 0 ||
+        size != header->size || header->size != (uint64_t)st.st_size) {
+        munmap(header, st.st_size);
+        PyErr_SetString(Lorcon2Exception, "Not a PyLorcon2 ring");
+        return -1;
+    }
+
+    if (consumer >= header->consumers) {
+        munmap(header, st.st_size);
+        PyErr_SetString(PyExc_ValueError, "Consumer index out of range");
+        return -1;
+    }
+
+    if (ring_claim_lane(ring_lane(header, consumer)) < 0) {
+        munmap(header, st.st_size);
+        PyErr_Format(PyExc_RuntimeError, "Consumer %u already has a reader", consumer);
+        return -1;
+    }
+
+    self->header = header;
+    self->consumer = consumer;
+    self->waiting = 0;
+
+    return 0;
+}
+
+/*
+    Wait up to timeout milliseconds (forever if negative) for a frame on
+    this reader's lane. Returns 1 if one is ready, 0 on timeout or once the
+    ring is closed (or its producer died) and drained, -1 if a signal
+    handler raised.
+*/
+static int
+PyLorcon2_RingReader_wait(PyLorcon2_RingReader *self, int timeout)
+{
+    PyLorcon2_RingHeader *header = self->header;
+    PyLorcon2_RingLane *lane = ring_lane(header, self->consumer);
+    struct timespec now, deadline, slice_end, nap;
+    long long poll = RING_POLL_MIN_NSEC, left, nsec;
+    int ready = 0, done = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    if (timeout > 0)
+        timespec_advance(&deadline, (long long)timeout * 1000000);
+
+    for (;;) {
+        Py_BEGIN_ALLOW_THREADS
+        clock_gettime(CLOCK_MONOTONIC, &slice_end);
+        timespec_advance(&slice_end, RING_SLICE_NSEC);
+        for (;;) {
+            if (__atomic_load_n(&lane->head, __ATOMIC_ACQUIRE) != lane->tail) {
+                ready = 1;
+                break;
+            }
+            if (__atomic_load_n(&header->closed, __ATOMIC_ACQUIRE)) {
+                /* The producer may have pushed right before closing */
+                ready = __atomic_load_n(&lane->head, __ATOMIC_ACQUIRE) != lane->tail;
+                done = 1;
+                break;
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (timeout >= 0 && timespec_elapsed(&now, &deadline) <= 0) {
+                done = 1;
+                break;
+            }
+            left = timespec_elapsed(&now, &slice_end);
+            if (left <= 0)
+                break;
+
+            /* Back off while idle, but never past the slice or the deadline */
+            nsec = poll < left ? poll : left;
+            if (timeout >= 0 && timespec_elapsed(&now, &deadline) < nsec)
+                nsec = timespec_elapsed(&now, &deadline);
+            nap.tv_sec = nsec / 1000000000;
+            nap.tv_nsec = nsec % 1000000000;
+            nanosleep(&nap, NULL);
+            if (poll < RING_POLL_MAX_NSEC)
+                poll *= 2;
+        }
+        Py_END_ALLOW_THREADS
+
+        if (ready)
+            return 1;
+        if (done)
+            return 0;
+        if (PyErr_CheckSignals() < 0)
+            return -1;
+
+        /* Close on behalf of a producer that died; other readers see it too */
+        if (ring_producer_gone(header))
+            __atomic_store_n(&header->closed, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static PyObject*
+PyLorcon2_RingReader_pop(PyLorcon2_RingReader *self)
+{
+    PyLorcon2_RingLane *lane = ring_lane(self->header, self->consumer);
+    PyLorcon2_RingSlot *slot;
+    PyObject *frame;
+    uint64_t tail;
+    uint32_t caplen;
+
+    /* Another thread reading through this object may have taken it */
+    tail = lane->tail;
+    if (__atomic_load_n(&lane->head, __ATOMIC_ACQUIRE) == tail) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    slot = ring_slot(self->header, self->consumer, tail);
+    caplen = slot->caplen;
+    if (caplen > self->header->snaplen)
+        caplen = self->header->snaplen;
+    frame = PyString_FromStringAndSize((char*)slot->data, caplen);
+    __atomic_store_n(&lane->tail, tail + 1, __ATOMIC_RELEASE);
+
+    return frame;
+}
+
+/*
+    Wait for and take the next frame. Returns a new string, None on timeout
+    or once the ring is closed and drained, or NULL with an exception set.
+*/
+static PyObject*
+PyLorcon2_RingReader_next(PyLorcon2_RingReader *self, int timeout)
+{
+    PyObject *frame;
+    int r;
+
+    for (;;) {
+        /* close() must not unmap the lane while we poll it without the GIL */
+        self->waiting++;
+        r = PyLorcon2_RingReader_wait(self, timeout);
+        self->waiting--;
+
+        if (r < 0)
+            return NULL;
+
+        if (r == 0) {
+            Py_INCREF(Py_None);
+            return Py_None;
+        }
+
+        frame = PyLorcon2_RingReader_pop(self);
+        if (frame != Py_None)
+            return frame;
+        Py_DECREF(frame);
+    }
+}
+
+
+PyDoc_STRVAR(PyLorcon2_RingReader_read__doc__, 
+    "read([timeout]) -> string or None\n\n"
+    "Return the next frame for this consumer, waiting up to timeout\n"
+    "milliseconds (forever by default). Return None on timeout or once the\n"
+    "ring has been closed and drained");
+
+static PyObject*
+PyLorcon2_RingReader_read(PyLorcon2_RingReader *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"timeout", NULL};
+    int timeout = -1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &timeout))
+        return NULL;
+
+    if (self->header == NULL) {
+        PyErr_SetString(PyExc_ValueError, "RingReader is closed");
+        return NULL;
+    }
+
+    return PyLorcon2_RingReader_next(self, timeout);
+}
+
+static PyObject*
+PyLorcon2_RingReader_iternext(PyLorcon2_RingReader *self)
+{
+    PyObject *frame;
+
+    if (self->header == NULL)
+        return NULL;
+
+    frame = PyLorcon2_RingReader_next(self, -1);
+    if (frame == Py_None) {
+        Py_DECREF(frame);
+        return NULL;
+    }
+
+    return frame;
+}
+
+
+PyDoc_STRVAR(PyLorcon2_RingReader_stats__doc__, 
+    "stats() -> tuple\n\n"
+    "Return (frames, drops, pending) for this consumer");
+
+static PyObject*
+PyLorcon2_RingReader_stats(PyLorcon2_RingReader *self)
+{
+    PyLorcon2_RingLane *lane;
+    uint64_t head, tail;
+
+    if (self->header == NULL) {
+        PyErr_SetString(PyExc_ValueError, "RingReader is closed");
+        return NULL;
+    }
+
+    lane = ring_lane(self->header, self->consumer);
+    head = __atomic_load_n(&lane->head, __ATOMIC_ACQUIRE);
+    tail = lane->tail;
+
+    return Py_BuildValue("(KKK)", (unsigned long long)head,
+                         (unsigned long long)__atomic_load_n(&lane->drops, __ATOMIC_RELAXED),
+                         (unsigned long long)(head - tail));
+}
+
+
+PyDoc_STRVAR(PyLorcon2_RingReader_close__doc__, 
+    "close() -> None\n\n"
+    "Detach from the ring");
+
+static PyObject*
+PyLorcon2_RingReader_close(PyLorcon2_RingReader *self)
+{
+    if (self->waiting) {
+        PyErr_SetString(PyExc_RuntimeError, "RingReader is being read");
+        return NULL;
+    }
+
+    PyLorcon2_RingReader_release(self);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+/*
+    ###########################################################################
+    
+    Fuzzer helpers
+    
+    ###########################################################################
+*/
+
+#define FUZZ_MAX_IES     64
+#define FUZZ_SLICE_NSEC  100000000   /* run() re-checks signals this often */
+
+static PyTypeObject PyLorcon2_ContextType;
+
+static uint64_t
+fuzz_splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* xorshift64* */
+static uint64_t
+fuzz_next(uint64_t *state)
+{
+    uint64_t x = *state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545f4914f6cdd1dULL;
+}
+
+/* Uniform integer in [0, n), n > 0 */
+static uint32_t
+fuzz_below(uint64_t *state, uint32_t n)
+{
+    return (uint32_t)(((fuzz_next(state) >> 32) * n) >> 32);
+}
+
+/* Offset of the first IE in a management frame, or -1 if it has none */
+static int
+fuzz_ie_offset(const u_char *frame, uint32_t length)
+{
+    if (length < 24 || (frame[0] & 0x0c) != 0)
+        return -1;
+
+    switch (frame[0] >> 4) {
+    case 0:  return 28;   /* association request */
+    case 1:               /* association response */
+    case 3:  return 30;   /* reassociation response */
+    case 2:  return 34;   /* reassociation request */
+    case 4:  return 24;   /* probe request */
+    case 5:               /* probe response */
+    case 8:  return 36;   /* beacon */
+    case 11: return 30;   /* authentication */
+    default: return -1;
+    }
+}
+
+static int
+fuzz_find_ies(const u_char *frame, uint32_t length, uint32_t *ies)
+{
+    int offset, n = 0;
+
+    offset = fuzz_ie_offset(frame, length);
+    if (offset < 0)
+        return 0;
+
+    while (n < FUZZ_MAX_IES && (uint32_t)offset + 2 <= length) {
+        ies[n++] = offset;
+        offset += 2 + frame[offset + 1];
+    }
+
+    return n;
+}
+
+/* Bytes of the IE at offset that are actually present in the frame */
+static uint32_t
+fuzz_ie_extent(const u_char *frame, uint32_t length, uint32_t ie)
+{
+    uint32_t extent = 2 + frame[ie + 1];
+
+    return extent < length - ie ? extent : length - ie;
+}
+
+static uint32_t
+fuzz_mutate_once(u_char *frame, uint32_t length, uint32_t mutation, uint64_t *state)
+{
+    static const uint8_t lengths[] = {0x00, 0x01, 0x7f, 0x80, 0xfe, 0xff};
+    static const uint8_t fields[][2] = {
+        {1, 1}, {2, 2}, {4, 6}, {10, 6}, {16, 6}, {22, 2}   /* 802.11 header */
+    };
+    uint32_t ies[FUZZ_MAX_IES], ie, extent, start, count, pos, i;
+    int n;
+
+    if (mutation == PYLORCON2_MUTATE_BITFLIP) {
+        for (count = 1 + fuzz_below(state, 8); count > 0; count--)
+            frame[fuzz_below(state, length)] ^= 1 << fuzz_below(state, 8);
+        return length;
+    }
+
+    if (mutation == PYLORCON2_MUTATE_FIELD) {
+        n = fuzz_ie_offset(frame, length);
+        i = fuzz_below(state, n > 24 ? 7 : 6);
+        if (i < 6) {
+            start = fields[i][0];
+            count = fields[i][1];
+        } else {
+            /* fixed parameters between the header and the IEs */
+            start = 24;
+            count = n - 24;
+        }
+        for (pos = start; pos < start + count && pos < length; pos++)
+            frame[pos] = (u_char)fuzz_next(state);
+        return length;
+    }
+
+    n = fuzz_find_ies(frame, length, ies);
+    if (n == 0)
+        return length;
+
+    ie = ies[fuzz_below(state, n)];
+    extent = fuzz_ie_extent(frame, length, ie);
+
+    switch (mutation) {
+    case PYLORCON2_MUTATE_IE_LENGTH:
+        i = fuzz_below(state, sizeof(lengths) + 3);
+        if (i < sizeof(lengths))
+            frame[ie + 1] = lengths[i];
+        else if (i == sizeof(lengths))
+            frame[ie + 1]++;
+        else if (i == sizeof(lengths) + 1)
+            frame[ie + 1]--;
+        else
+            frame[ie + 1] = (u_char)fuzz_next(state);
+        break;
+
+    case PYLORCON2_MUTATE_IE_VALUE:
+        if (extent <= 2)
+            break;
+        start = ie + 2 + fuzz_below(state, extent - 2);
+        count = 1 + fuzz_below(state, ie + extent - start);
+        i = fuzz_below(state, 3);
+        for (pos = start; pos < start + count; pos++)
+            frame[pos] = i == 0 ? 0x00 : i == 1 ? 0xff : (u_char)fuzz_next(state);
+        break;
+
+    case PYLORCON2_MUTATE_IE_DUPLICATE:
+        if (length + extent > PYLORCON2_FUZZ_MAX_FRAME)
+            break;
+        /* insert the copy in front of a random IE or at the end */
+        i = fuzz_below(state, n + 1);
+        pos = i < (uint32_t)n ? ies[i] : length;
+        memmove(frame + pos + extent, frame + pos, length - pos);
+        memcpy(frame + pos, frame + (ie >= pos ? ie + extent : ie), extent);
+        length += extent;
+        break;
+
+    case PYLORCON2_MUTATE_IE_TRUNCATE:
+        length = ie + 1 + fuzz_below(state, extent);
+        break;
+    }
+
+    return length;
+}
+
+/* Build mutant number index into frame and return its length */
+static uint32_t
+fuzz_generate(PyLorcon2_Fuzzer *self, uint64_t index, u_char *frame)
+{
+    uint32_t enabled[8], nenabled = 0, length, pick, count, bit;
+    uint64_t state, x;
+
+    x = self->seed;
+    x = fuzz_splitmix64(&x) ^ index;
+    state = fuzz_splitmix64(&x);
+    if (state == 0)
+        state = 1;
+
+    for (bit = PYLORCON2_MUTATE_BITFLIP; bit <= PYLORCON2_MUTATE_FIELD; bit <<= 1)
+        if (self->mutations & bit)
+            enabled[nenabled++] = bit;
+
+    pick = fuzz_below(&state, self->frames);
+    length = self->offsets[pick + 1] - self->offsets[pick];
+    memcpy(frame, self->corpus + self->offsets[pick], length);
+
+    for (count = 1 + fuzz_below(&state, self->max_mutations); count > 0; count--)
+        length = fuzz_mutate_once(frame, length,
+                                  enabled[fuzz_below(&state, nenabled)], &state);
+
+    return length;
+}
+
+/*
+    ###########################################################################
+    
+    Class Fuzzer
+    
+    ###########################################################################
+*/
+
+static void
+PyLorcon2_Fuzzer_dealloc(PyLorcon2_Fuzzer *self)
+{
+    Py_XDECREF(self->context);
+    PyMem_Free(self->corpus);
+    PyMem_Free(self->offsets);
+    PyMem_Free(self->log);
+    self->ob_type->tp_free((PyObject*)self);
+}
+
+static int
+PyLorcon2_Fuzzer_init(PyLorcon2_Fuzzer *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"context", "corpus", "seed", "mutations",
+                             "max_mutations", "log_size", NULL};
+    PyLorcon2_Context *context;
+    PyObject *corpus, *seq, *item;
+    unsigned long long seed = 0;
+    unsigned int mutations = PYLORCON2_MUTATE_ALL, max_mutations = 4, log_size = 4096;
+    Py_ssize_t n, i, total = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O|KIII", kwlist,
+                                     &PyLorcon2_ContextType, &context, &corpus,
+                                     &seed, &mutations, &max_mutations, &log_size))
+        return -1;
+
+    if (self->context != NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Fuzzer is already initialized");
+        return -1;
+    }
+
+    if ((mutations & PYLORCON2_MUTATE_ALL) == 0 || (mutations & ~PYLORCON2_MUTATE_ALL) != 0) {
+        PyErr_SetString(PyExc_ValueError, "mutations must be a non-empty mask of MUTATE_* flags");
+        return -1;
+    }
+
+    if (max_mutations == 0 || log_size == 0) {
+        PyErr_SetString(PyExc_ValueError, "max_mutations and log_size must be positive");
+        return -1;
+    }
+
+    seq = PySequence_Fast(corpus, "corpus must be a sequence of strings");
+    if (!seq)
+        return -1;
+
+    n = PySequence_Fast_GET_SIZE(seq);
+    if (n == 0) {
+        PyErr_SetString(PyExc_ValueError, "corpus is empty");
+        Py_DECREF(seq);
+        return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        if (!PyString_Check(item) || PyString_GET_SIZE(item) == 0 ||
+            PyString_GET_SIZE(item) > PYLORCON2_FUZZ_MAX_FRAME) {
+            PyErr_Format(PyExc_ValueError,
+                         "corpus entries must be non-empty strings of at most %d bytes",
+                         PYLORCON2_FUZZ_MAX_FRAME);
+            Py_DECREF(seq);
+            return -1;
+        }
+        total += PyString_GET_SIZE(item);
+    }
+
+    self->corpus = PyMem_Malloc(total);
+    self->offsets = PyMem_Malloc((n + 1) * sizeof(uint32_t));
+    self->log = PyMem_Malloc(log_size * sizeof(PyLorcon2_FuzzLogEntry));
+    if (!self->corpus || !self->offsets || !self->log) {
+        Py_DECREF(seq);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    self->offsets[0] = 0;
+    for (i = 0; i < n; i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        memcpy(self->corpus + self->offsets[i], PyString_AS_STRING(item),
+               PyString_GET_SIZE(item));
+        self->offsets[i + 1] = self->offsets[i] + (uint32_t)PyString_GET_SIZE(item);
+    }
+    Py_DECREF(seq);
+
+    Py_INCREF(context);
+    self->context = context;
+    self->frames = (uint32_t)n;
+    self->seed = seed;
+    self->mutations = mutations;
+    self->max_mutations = max_mutations;
+    self->index = 0;
+    self->log_size = log_size;
+    self->logged = 0;
+
+    return 0;
+}
+
+
+PyDoc_STRVAR(PyLorcon2_Fuzzer_run__doc__, 
+    "run([count[, rate]]) -> integer\n\n"
+    "Inject count mutants (until stop() if count <= 0) at up to rate frames\n"
+    "per second (unpaced if rate <= 0), without holding the GIL. Return the\n"
+    "number of frames injected");
+
+static PyObject*
+PyLorcon2_Fuzzer_run(PyLorcon2_Fuzzer *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"count", "rate", NULL};
+    long long count = 0, sent = 0, interval = 0;
+    struct timespec deadline, slice, now, wake;
+    PyLorcon2_FuzzLogEntry *entry;
+    double rate = 0;
+    uint32_t length;
+    int done = 0, failed = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Ld", kwlist, &count, &rate))
+        return NULL;
+
+    if (!self->context->monitored) {
+        PyErr_SetString(PyExc_RuntimeError, "Context must be in monitor/injection-mode");
+        return NULL;
+    }
+
+    if (self->running) {
+        PyErr_SetString(PyExc_RuntimeError, "Fuzzer is already running");
+        return NULL;
+    }
+
+    if (rate > 0)
+        interval = (long long)(1e9 / rate);
+
+    /* Context.close() refuses while we inject through it */
+    __atomic_add_fetch(&self->context->sending, 1, __ATOMIC_ACQ_REL);
+    self->running = 1;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    while (!done) {
+        Py_BEGIN_ALLOW_THREADS
+        clock_gettime(CLOCK_MONOTONIC, &slice);
+        for (;;) {
+            if (self->stop || (count > 0 && sent >= count)) {
+                done = 1;
+                break;
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (timespec_elapsed(&slice, &now) >= FUZZ_SLICE_NSEC)
+                break;
+
+            if (interval && timespec_elapsed(&now, &deadline) > 0) {
+                /* Not due yet; never nap past the end of this slice */
+                wake = slice;
+                timespec_advance(&wake, FUZZ_SLICE_NSEC);
+                if (timespec_elapsed(&deadline, &wake) > 0)
+                    wake = deadline;
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+                continue;
+            }
+
+            length = fuzz_generate(self, self->index, self->buffer);
+
+            /*
+                Log before sending so a frame that wedges the target is kept.
+                get_log() may read from another thread: publish the entry
+                before the count that covers it.
+            */
+            entry = &self->log[self->logged % self->log_size];
+            __atomic_store_n(&entry->seed, self->seed, __ATOMIC_RELAXED);
+            __atomic_store_n(&entry->index, self->index, __ATOMIC_RELAXED);
+            __atomic_store_n(&self->logged, self->logged + 1, __ATOMIC_RELEASE);
+
+            if (lorcon_send_bytes(self->context->context, length, self->buffer) < 0) {
+                failed = done = 1;
+                break;
+            }
+            self->index++;
+            sent++;
+
+            if (interval) {
+                timespec_advance(&deadline, interval);
+                if (timespec_elapsed(&deadline, &now) > 0)
+                    deadline = now;   /* fell behind; don't burst to catch up */
+            }
+        }
+        Py_END_ALLOW_THREADS
+
+        if (!done && PyErr_CheckSignals() < 0)
+            break;
+    }
+
+    /* Cleared here rather than on entry so a stop() that beats us in isn't lost */
+    self->stop = 0;
+    self->running = 0;
+    __atomic_sub_fetch(&self->context->sending, 1, __ATOMIC_ACQ_REL);
+
+    if (!done)
+        return NULL;
+
+    if (failed) {
+        PyErr_SetString(Lorcon2Exception, lorcon_get_error(self->context->context));
+        return NULL;
+    }
+
+    return PyLong_FromLongLong(sent);
+}
+
+
+PyDoc_STRVAR(PyLorcon2_Fuzzer_stop__doc__, 
+    "stop() -> None\n\n"
+    "Make run() in another thread return after the current frame");
+
+static PyObject*
+PyLorcon2_Fuzzer_stop(PyLorcon2_Fuzzer *self)
+{
+    self->stop = 1;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
+PyDoc_STRVAR(PyLorcon2_Fuzzer_generate__doc__, 
+    "generate(index) -> string\n\n"
+    "Regenerate mutant number index exactly as run() injects it");
+
+static PyObject*
+PyLorcon2_Fuzzer_generate(PyLorcon2_Fuzzer *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"index", NULL};
+    u_char frame[PYLORCON2_FUZZ_MAX_FRAME];
+    unsigned long long index;
+    uint32_t length;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "K", kwlist, &index))
+        return NULL;
+
+    length = fuzz_generate(self, index, frame);
+
+    return PyString_FromStringAndSize((char*)frame, length);
+}
+
+
+PyDoc_STRVAR(PyLorcon2_Fuzzer_get_log__doc__, 
+    "get_log() -> list\n\n"
+    "Return the (seed, index) of the most recently injected frames, oldest first");
+
+static PyObject*
+PyLorcon2_Fuzzer_get_log(PyLorcon2_Fuzzer *self)
+{
+    PyObject *retval, *entry;
+    PyLorcon2_FuzzLogEntry *copy, *e;
+    uint64_t base, first, last, now, i;
+
+    /* run() may be appending from another thread without the GIL */
+    last = __atomic_load_n(&self->logged, __ATOMIC_ACQUIRE);
+    base = last > self->log_size ? last - self->log_size : 0;
+
+    copy = PyMem_Malloc((size_t)(last - base) * sizeof(PyLorcon2_FuzzLogEntry) + 1);
+    if (!copy)
+        return PyErr_NoMemory();
+
+    for (i = base; i < last; i++) {
+        e = &self->log[i % self->log_size];
+        copy[i - base].seed = __atomic_load_n(&e->seed, __ATOMIC_RELAXED);
+        copy[i - base].index = __atomic_load_n(&e->index, __ATOMIC_RELAXED);
+    }
+
+    /*
+        A running run() may have lapped us, and may be rewriting the slot of
+        entry now - log_size before it publishes `now + 1`: drop those.
+    */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    now = __atomic_load_n(&self->logged, __ATOMIC_RELAXED);
+    first = base;
+    if (self->running && now >= base + self->log_size)
+        first = now - self->log_size + 1;
+    if (first > last)
+        first = last;
+
+    retval = PyList_New((Py_ssize_t)(last - first));
+    if (!retval) {
+        PyMem_Free(copy);
+        return NULL;
+    }
+
+    for (i = first; i < last; i++) {
+        e = &copy[i - base];
+        entry = Py_BuildValue("(KK)", (unsigned long long)e->seed,
+                              (unsigned long long)e->index);
+        if (!entry) {
+            Py_DECREF(retval);
+            PyMem_Free(copy);
+            return NULL;
+        }
+        PyList_SET_ITEM(retval, (Py_ssize_t)(i - first), entry);
+    }
+
+    PyMem_Free(copy);
+    return retval;
+}
+
+
+PyDoc_STRVAR(PyLorcon2_Fuzzer_get_index__doc__, 
+    "get_index() -> integer\n\n"
+    "Get the index of the next mutant to inject");
+
+static PyObject*
+PyLorcon2_Fuzzer_get_index(PyLorcon2_Fuzzer *self)
+{
+    return PyLong_FromUnsignedLongLong(self->index);
+}
+
+
+PyDoc_STRVAR(PyLorcon2_Fuzzer_set_index__doc__, 
+    "set_index(integer) -> None\n\n"
+    "Set the index of the next mutant to inject, e.g. to resume a run");
+
+static PyObject*
+PyLorcon2_Fuzzer_set_index(PyLorcon2_Fuzzer *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"index", NULL};
+    unsigned long long index;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "K", kwlist, &index))
+        return NULL;
+
+    if (self->running) {
+        PyErr_SetString(PyExc_RuntimeError, "Fuzzer is running");
+        return NULL;
+    }
+
+    self->index = index;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+/*
+    ###########################################################################
+    
+    Definitions
+    
+    ###########################################################################
+*/
+
+static PyMethodDef PyLorcon2Methods[] =
+{
+    {"get_version",  PyLorcon2_get_version,  METH_NOARGS,  PyLorcon2_get_version__doc__},
+    {"list_drivers", PyLorcon2_list_drivers, METH_NOARGS,  PyLorcon2_list_drivers__doc__},
+    {"find_driver",  PyLorcon2_find_driver,  METH_VARARGS, PyLorcon2_find_driver__doc__},
+    {"auto_driver",  PyLorcon2_auto_driver,  METH_VARARGS, PyLorcon2_auto_driver__doc__},
+    {"lorcon_loop", PyLorcon2_lorcon_loop, METH_VARARGS, PyLorcon2_lorcon_loop__doc__},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyMethodDef PyLorcon2_Context_Methods[] =
+{
+    {"open_inject",     (PyCFunction)PyLorcon2_Context_open_inject,     METH_NOARGS,  PyLorcon2_Context_open_inject__doc__},
+    {"open_monitor",    (PyCFunction)PyLorcon2_Context_open_monitor,    METH_NOARGS,  PyLorcon2_Context_open_monitor__doc__},
+    {"open_injmon",     (PyCFunction)PyLorcon2_Context_open_injmon,     METH_NOARGS,  PyLorcon2_Context_open_injmon__doc__},
+    {"close",           (PyCFunction)PyLorcon2_Context_close,           METH_NOARGS,  PyLorcon2_Context_close__doc__},
+    {"get_error",       (PyCFunction)PyLorcon2_Context_get_error,       METH_NOARGS,  PyLorcon2_Context_get_error__doc__},
+    {"get_capiface",    (PyCFunction)PyLorcon2_Context_get_capiface,    METH_NOARGS,  PyLorcon2_Context_get_capiface__doc__},
+    {"send_bytes",      (PyCFunction)PyLorcon2_Context_send_bytes,      METH_VARARGS, PyLorcon2_Context_send_bytes__doc__},
+    {"set_timeout",     (PyCFunction)PyLorcon2_Context_set_timeout,
+                        METH_VARARGS | METH_KEYWORDS, PyLorcon2_Context_set_timeout__doc__},
+    {"get_timeout",     (PyCFunction)PyLorcon2_Context_get_timeout,     METH_NOARGS,  PyLorcon2_Context_get_timeout__doc__},
+    {"set_vap",         (PyCFunction)PyLorcon2_Context_set_vap,
+                        METH_VARARGS | METH_KEYWORDS, PyLorcon2_Context_set_vap__doc__},
+    {"get_vap",         (PyCFunction)PyLorcon2_Context_get_vap,         METH_NOARGS,  PyLorcon2_Context_get_vap__doc__},
+    {"get_driver_name", (PyCFunction)PyLorcon2_Context_get_driver_name, METH_NOARGS,  PyLorcon2_Context_get_driver_name__doc__},
+    {"set_channel",     (PyCFunction)PyLorcon2_Context_set_channel,     METH_VARARGS, PyLorcon2_Context_set_channel__doc__},
+    {"get_channel",     (PyCFunction)PyLorcon2_Context_get_channel,     METH_NOARGS,  PyLorcon2_Context_get_channel__doc__},
+    {"set_hwmac",       (PyCFunction)PyLorcon2_Context_set_hwmac,       METH_VARARGS, PyLorcon2_Context_set_hwmac__doc__},
+    {"get_hwmac",       (PyCFunction)PyLorcon2_Context_get_hwmac,       METH_NOARGS,  PyLorcon2_Context_get_hwmac__doc__},
+    {"fanout",          (PyCFunction)PyLorcon2_Context_fanout,
+                        METH_VARARGS | METH_KEYWORDS, PyLorcon2_Context_fanout__doc__},
+    {"loop",            (PyCFunction)PyLorcon2_Context_loop,
+                        METH_VARARGS | METH_KEYWORDS, PyLorcon2_Context_loop__doc__},
+    {"breakloop",       (PyCFunction)PyLorcon2_Context_breakloop,       METH_NOARGS,  PyLorcon2_Context_breakloop__doc__},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject PyLorcon2_ContextType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                                        /* ob_size */
+    "PyLorcon2.Context",                      /* tp_name */
+    sizeof(PyLorcon2_Context),                /* tp_basic_size */
+    0,                                        /* tp_itemsize */
+    (destructor)PyLorcon2_Context_dealloc,    /* tp_dealloc */
+    0,                                        /* tp_print */
+    0,                                        /* tp_getattr */
+    0,                                        /* tp_setattr */
+    0,                                        /* tp_compare */
+    0,                                        /* tp_repr */
+    0,                                        /* tp_as_number */
+    0,                                        /* tp_as_sequence */
+    0,                                        /* tp_as_mapping */
+    0,                                        /* tp_hash */
+    0,                                        /* tp_call */
+    0,                                        /* tp_str */
+    0,                                        /* tp_getattro */
+    0,                                        /* tp_setattro */
+    0,                                        /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+    "PyLorcon2 Context Object",               /* tp_doc */
+    0,                                        /* tp_traverse */
+    0,                                        /* tp_clear */
+    0,                                        /* tp_richcompare */
+    0,                                        /* tp_weaklistoffset */
+    0,                                        /* tp_iter */
+    0,                                        /* tp_iternext */
+    PyLorcon2_Context_Methods,                /* tp_methods */
+    0,                                        /* tp_members */
+    0,                                        /* tp_getset */
+    0,                                        /* tp_base */
+    0,                                        /* tp_dict */
+    0,                                        /* tp_descr_get */
+    0,                                        /* tp_descr_set */
+    0,                                        /* tp_dictoffset */
+    (initproc)PyLorcon2_Context_init,         /* tp_init */
+    0,                                        /* tp_alloc */
+    0,                                        /* tp_new */
+};
+
+static PyMethodDef PyLorcon2_Ring_Methods[] =
+{
+    {"close",           (PyCFunction)PyLorcon2_Ring_close,              METH_NOARGS,  PyLorcon2_Ring_close__doc__},
+    {"stats",           (PyCFunction)PyLorcon2_Ring_stats,              METH_NOARGS,  PyLorcon2_Ring_stats__doc__},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject PyLorcon2_RingType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                                        /* ob_size */
+    "PyLorcon2.Ring",                         /* tp_name */
+    sizeof(PyLorcon2_Ring),                   /* tp_basic_size */
+    0,                                        /* tp_itemsize */
+    (destructor)PyLorcon2_Ring_dealloc,       /* tp_dealloc */
+    0,                                        /* tp_print */
+    0,                                        /* tp_getattr */
+    0,                                        /* tp_setattr */
+    0,                                        /* tp_compare */
+    0,                                        /* tp_repr */
+    0,                                        /* tp_as_number */
+    0,                                        /* tp_as_sequence */
+    0,                                        /* tp_as_mapping */
+    0,                                        /* tp_hash */
+    0,                                        /* tp_call */
+    0,                                        /* tp_str */
+    0,                                        /* tp_getattro */
+    0,                                        /* tp_setattro */
+    0,                                        /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                       /* tp_flags */
+    "Shared-memory ring filled by Context.fanout()", /* tp_doc */
+    0,                                        /* tp_traverse */
+    0,                                        /* tp_clear */
+    0,                                        /* tp_richcompare */
+    0,                                        /* tp_weaklistoffset */
+    0,                                        /* tp_iter */
+    0,                                        /* tp_iternext */
+    PyLorcon2_Ring_Methods,                   /* tp_methods */
+    0,                                        /* tp_members */
+    0,                                        /* tp_getset */
+    0,                                        /* tp_base */
+    0,                                        /* tp_dict */
+    0,                                        /* tp_descr_get */
+    0,                                        /* tp_descr_set */
+    0,                                        /* tp_dictoffset */
+    (initproc)PyLorcon2_Ring_init,            /* tp_init */
+    0,                                        /* tp_alloc */
+    0,                                        /* tp_new */
+};
+
+static PyMethodDef PyLorcon2_RingReader_Methods[] =
+{
+    {"read",            (PyCFunction)PyLorcon2_RingReader_read,
+                        METH_VARARGS | METH_KEYWORDS, PyLorcon2_RingReader_read__doc__},
+    {"stats",           (PyCFunction)PyLorcon2_RingReader_stats,        METH_NOARGS,  PyLorcon2_RingReader_stats__doc__},
+    {"close",           (PyCFunction)PyLorcon2_RingReader_close,        METH_NOARGS,  PyLorcon2_RingReader_close__doc__},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject PyLorcon2_RingReaderType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                                        /* ob_size */
+    "PyLorcon2.RingReader",                   /* tp_name */
+    sizeof(PyLorcon2_RingReader),             /* tp_basic_size */
+    0,                                        /* tp_itemsize */
+    (destructor)PyLorcon2_RingReader_dealloc, /* tp_dealloc */
+    0,                                        /* tp_print */
+    0,                                        /* tp_getattr */
+    0,                                        /* tp_setattr */
+    0,                                        /* tp_compare */
+    0,                                        /* tp_repr */
+    0,                                        /* tp_as_number */
+    0,                                        /* tp_as_sequence */
+    0,                                        /* tp_as_mapping */
+    0,                                        /* tp_hash */
+    0,                                        /* tp_call */
+    0,                                        /* tp_str */
+    0,                                        /* tp_getattro */
+    0,                                        /* tp_setattro */
+    0,                                        /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_ITER, /* tp_flags */
+    "Worker-side view of one consumer lane of a Ring", /* tp_doc */
+    0,                                        /* tp_traverse */
+    0,                                        /* tp_clear */
+    0,                                        /* tp_richcompare */
+    0,                                        /* tp_weaklistoffset */
+    PyObject_SelfIter,                        /* tp_iter */
+    (iternextfunc)PyLorcon2_RingReader_iternext, /* tp_iternext */
+    PyLorcon2_RingReader_Methods,             /* tp_methods */
+    0,                                        /* tp_members */
+    0,                                        /* tp_getset */
+    0,                                        /* tp_base */
+    0,                                        /* tp_dict */
+    0,                                        /* tp_descr_get */
+    0,                                        /* tp_descr_set */
+    0,                                        /* tp_dictoffset */
+    (initproc)PyLorcon2_RingReader_init,      /* tp_init */
+    0,                                        /* tp_alloc */
+    0,                                        /* tp_new */
+};
+
+static PyMethodDef PyLorcon2_Fuzzer_Methods[] =
+{
+    {"run",             (PyCFunction)PyLorcon2_Fuzzer_run,
+                        METH_VARARGS | METH_KEYWORDS, PyLorcon2_Fuzzer_run__doc__},
+    {"stop",            (PyCFunction)PyLorcon2_Fuzzer_stop,             METH_NOARGS,  PyLorcon2_Fuzzer_stop__doc__},
+    {"generate",        (PyCFunction)PyLorcon2_Fuzzer_generate,
+                        METH_VARARGS | METH_KEYWORDS, PyLorcon2_Fuzzer_generate__doc__},
+    {"get_log",         (PyCFunction)PyLorcon2_Fuzzer_get_log,          METH_NOARGS,  PyLorcon2_Fuzzer_get_log__doc__},
+    {"get_index",       (PyCFunction)PyLorcon2_Fuzzer_get_index,        METH_NOARGS,  PyLorcon2_Fuzzer_get_index__doc__},
+    {"set_index",       (PyCFunction)PyLorcon2_Fuzzer_set_index,
+                        METH_VARARGS | METH_KEYWORDS, PyLorcon2_Fuzzer_set_index__doc__},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject PyLorcon2_FuzzerType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                                        /* ob_size */
+    "PyLorcon2.Fuzzer",                       /* tp_name */
+    sizeof(PyLorcon2_Fuzzer),                 /* tp_basic_size */
+    0,                                        /* tp_itemsize */
+    (destructor)PyLorcon2_Fuzzer_dealloc,     /* tp_dealloc */
+    0,                                        /* tp_print */
+    0,                                        /* tp_getattr */
+    0,                                        /* tp_setattr */
+    0,                                        /* tp_compare */
+    0,                                        /* tp_repr */
+    0,                                        /* tp_as_number */
+    0,                                        /* tp_as_sequence */
+    0,                                        /* tp_as_mapping */
+    0,                                        /* tp_hash */
+    0,                                        /* tp_call */
+    0,                                        /* tp_str */
+    0,                                        /* tp_getattro */
+    0,                                        /* tp_setattro */
+    0,                                        /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                       /* tp_flags */
+    "Seeded 802.11 frame fuzzer injecting through a Context", /* tp_doc */
+    0,                                        /* tp_traverse */
+    0,                                        /* tp_clear */
+    0,                                        /* tp_richcompare */
+    0,                                        /* tp_weaklistoffset */
+    0,                                        /* tp_iter */
+    0,                                        /* tp_iternext */
+    PyLorcon2_Fuzzer_Methods,                 /* tp_methods */
+    0,                                        /* tp_members */
+    0,                                        /* tp_getset */
+    0,                                        /* tp_base */
+    0,                                        /* tp_dict */
+    0,                                        /* tp_descr_get */
+    0,                                        /* tp_descr_set */
+    0,                                        /* tp_dictoffset */
+    (initproc)PyLorcon2_Fuzzer_init,          /* tp_init */
+    0,                                        /* tp_alloc */
+    0,                                        /* tp_new */
+};
+
+
+/*
+    ###########################################################################
+    
+    C API
+    
+    ###########################################################################
+*/
+
+static struct lorcon*
+PyLorcon2_CAPI_Context_AsLorcon(PyObject *context)
+{
+    if (!PyObject_TypeCheck(context, &PyLorcon2_ContextType)) {
+        PyErr_SetString(PyExc_TypeError, "Expected a PyLorcon2.Context");
+        return NULL;
+    }
+
+    return ((PyLorcon2_Context*)context)->context;
+}
+
+static int
+PyLorcon2_CAPI_Context_SendBytes(PyObject *context, const u_char *data, int length)
+{
+    PyLorcon2_Context *self = (PyLorcon2_Context*)context;
+    int sent = -1;
+
+    /* Register first so close() cannot slip in between check and send */
+    for (;;) {
+        __atomic_add_fetch(&self->sending, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&self->closing, __ATOMIC_SEQ_CST))
+            break;
+        /* A close() is deciding; let it finish, then look again */
+        __atomic_sub_fetch(&self->sending, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&self->closing, __ATOMIC_ACQUIRE))
+            sched_yield();
+    }
+
+    if (__atomic_load_n(&self->monitored, __ATOMIC_ACQUIRE))
+        sent = lorcon_send_bytes(self->context, length, (u_char*)data);
+    __atomic_sub_fetch(&self->sending, 1, __ATOMIC_SEQ_CST);
+
+    return sent;
+}
+
+static int
+PyLorcon2_CAPI_Context_SetHandler(PyObject *context, lorcon_handler handler, void *user)
+{
+    PyLorcon2_Context *self;
+
+    if (!PyObject_TypeCheck(context, &PyLorcon2_ContextType)) {
+        PyErr_SetString(PyExc_TypeError, "Expected a PyLorcon2.Context");
+        return -1;
+    }
+
+    self = (PyLorcon2_Context*)context;
+    if (self->capturing) {
+        PyErr_SetString(PyExc_RuntimeError, "Context is capturing; call breakloop() first");
+        return -1;
+    }
+
+    self->handler = handler;
+    self->handler_user = handler ? user : NULL;
+
+    return 0;
+}
+
+static PyLorcon2_CAPI PyLorcon2_API = {
+    PYLORCON2_CAPI_VERSION,
+    &PyLorcon2_ContextType,
+    PyLorcon2_CAPI_Context_AsLorcon,
+    PyLorcon2_CAPI_Context_SendBytes,
+    PyLorcon2_CAPI_Context_SetHandler,
+};
+
+
+/*
+    ###########################################################################
+    
+    Module initialization
+    
+    ###########################################################################
+*/
+
+PyMODINIT_FUNC
+initPyLorcon2(void)
+{
+    PyObject *m, *capi;
+
+    if(PyType_Ready(&PyLorcon2_ContextType) < 0)
+        return;
+
+    if(PyType_Ready(&PyLorcon2_RingType) < 0)
+        return;
+
+    if(PyType_Ready(&PyLorcon2_RingReaderType) < 0)
+        return;
+
+    if(PyType_Ready(&PyLorcon2_FuzzerType) < 0)
+        return;
+
+    m = Py_InitModule3("PyLorcon2", PyLorcon2Methods, "Wrapper for the Lorcon2 library");
+
+    if(m == NULL)
+        return;
+
+    /* Lorcon2 Exception */
+    Lorcon2Exception = PyErr_NewException("PyLorcon2.Lorcon2Exception", NULL, NULL);
+    Py_INCREF(Lorcon2Exception);
+    PyModule_AddObject(m, "Lorcon2Exception", Lorcon2Exception);
+
+    /* Lorcon2 Context Object */
+    Py_INCREF(&PyLorcon2_ContextType);
+    PyLorcon2_ContextType.tp_getattro = PyObject_GenericGetAttr;
+    PyLorcon2_ContextType.tp_setattro = PyObject_GenericSetAttr;
+    PyLorcon2_ContextType.tp_alloc  = PyType_GenericAlloc;
+    PyLorcon2_ContextType.tp_new = PyType_GenericNew;
+    PyLorcon2_ContextType.tp_free = _PyObject_Del;
+    PyModule_AddObject(m, "Context", (PyObject*)&PyLorcon2_ContextType);
+
+    /* Shared-memory fan-out */
+    Py_INCREF(&PyLorcon2_RingType);
+    PyLorcon2_RingType.tp_getattro = PyObject_GenericGetAttr;
+    PyLorcon2_RingType.tp_setattro = PyObject_GenericSetAttr;
+    PyLorcon2_RingType.tp_alloc  = PyType_GenericAlloc;
+    PyLorcon2_RingType.tp_new = PyType_GenericNew;
+    PyLorcon2_RingType.tp_free = _PyObject_Del;
+    PyModule_AddObject(m, "Ring", (PyObject*)&PyLorcon2_RingType);
+
+    Py_INCREF(&PyLorcon2_RingReaderType);
+    PyLorcon2_RingReaderType.tp_getattro = PyObject_GenericGetAttr;
+    PyLorcon2_RingReaderType.tp_setattro = PyObject_GenericSetAttr;
+    PyLorcon2_RingReaderType.tp_alloc  = PyType_GenericAlloc;
+    PyLorcon2_RingReaderType.tp_new = PyType_GenericNew;
+    PyLorcon2_RingReaderType.tp_free = _PyObject_Del;
+    PyModule_AddObject(m, "RingReader", (PyObject*)&PyLorcon2_RingReaderType);
+
+    PyModule_AddIntConstant(m, "FANOUT_HASH", PYLORCON2_FANOUT_HASH);
+    PyModule_AddIntConstant(m, "FANOUT_RR", PYLORCON2_FANOUT_RR);
+
+    /* Frame fuzzer */
+    Py_INCREF(&PyLorcon2_FuzzerType);
+    PyLorcon2_FuzzerType.tp_getattro = PyObject_GenericGetAttr;
+    PyLorcon2_FuzzerType.tp_setattro = PyObject_GenericSetAttr;
+    PyLorcon2_FuzzerType.tp_alloc  = PyType_GenericAlloc;
+    PyLorcon2_FuzzerType.tp_new = PyType_GenericNew;
+    PyLorcon2_FuzzerType.tp_free = _PyObject_Del;
+    PyModule_AddObject(m, "Fuzzer", (PyObject*)&PyLorcon2_FuzzerType);
+
+    PyModule_AddIntConstant(m, "MUTATE_BITFLIP", PYLORCON2_MUTATE_BITFLIP);
+    PyModule_AddIntConstant(m, "MUTATE_IE_LENGTH", PYLORCON2_MUTATE_IE_LENGTH);
+    PyModule_AddIntConstant(m, "MUTATE_IE_VALUE", PYLORCON2_MUTATE_IE_VALUE);
+    PyModule_AddIntConstant(m, "MUTATE_IE_DUPLICATE", PYLORCON2_MUTATE_IE_DUPLICATE);
+    PyModule_AddIntConstant(m, "MUTATE_IE_TRUNCATE", PYLORCON2_MUTATE_IE_TRUNCATE);
+    PyModule_AddIntConstant(m, "MUTATE_FIELD", PYLORCON2_MUTATE_FIELD);
+    PyModule_AddIntConstant(m, "MUTATE_ALL", PYLORCON2_MUTATE_ALL);
+
+    /* C API for other extensions, see PyLorcon2.h */
+    capi = PyCapsule_New(&PyLorcon2_API, PYLORCON2_CAPI_NAME, NULL);
+    if (capi != NULL)
+        PyModule_AddObject(m, "_C_API", capi);
 }
 
@@ -24,12 +24,171 @@
 #ifndef __PYLORCON2__
 #define __PYLORCON2__
 
+/*
+    Other extensions include this header after <Python.h> and
+    <lorcon2/lorcon.h> and call PyLorcon2_ImportAPI() from their module
+    init to reach contexts through PyLorcon2_API without Python calls.
+*/
+
+#ifdef PYLORCON2_MODULE
 static PyObject *Lorcon2Exception;
+#endif
 
 typedef struct {
   PyObject_HEAD
   struct lorcon *context;
   char monitored;
+  char capturing;
+  int sending;             /* injections running without the GIL */
+  char closing;            /* close() is checking `sending` */
+  lorcon_handler handler;  /* native callback for Context.loop() */
+  void *handler_user;
 } PyLorcon2_Context;
 
+#define PYLORCON2_CAPI_NAME     "PyLorcon2._C_API"
+#define PYLORCON2_CAPI_VERSION  1
+
+typedef struct {
+  int version;
+  PyTypeObject *ContextType;
+
+  /* The lorcon context of a Context, or NULL with an exception set */
+  struct lorcon *(*Context_AsLorcon)(PyObject *context);
+
+  /* lorcon_send_bytes() on an open Context. Does not need the GIL, but
+     the caller must keep a reference to the Context. Context.close() is
+     refused while a send is in progress. Returns lorcon's result, or -1
+     without calling lorcon if the Context has not been opened or has been
+     closed; a close() that is refused never causes a -1 */
+  int (*Context_SendBytes)(PyObject *context, const u_char *data, int length);
+
+  /* Set (or clear, with NULL) the handler run for each packet by
+     Context.loop(); user is passed through untouched. Needs the GIL;
+     -1 with an exception set on error. Fails with RuntimeError while the
+     Context is capturing, so once it returns the old handler and user
+     are no longer in use and may be freed */
+  int (*Context_SetHandler)(PyObject *context, lorcon_handler handler, void *user);
+} PyLorcon2_CAPI;
+
+#ifndef PYLORCON2_MODULE
+static PyLorcon2_CAPI *PyLorcon2_API;
+
+#define PyLorcon2_ImportAPI() \
+    ((PyLorcon2_API = (PyLorcon2_CAPI*)PyCapsule_Import(PYLORCON2_CAPI_NAME, 0)) == NULL ? -1 : \
+     PyLorcon2_API->version != PYLORCON2_CAPI_VERSION ? \
+     (PyErr_SetString(PyExc_ImportError, "PyLorcon2 C API version mismatch"), -1) : 0)
+#endif
+
+/*
+    Shared-memory fan-out ring.
+
+    The segment starts with a PyLorcon2_RingHeader, followed by one
+    PyLorcon2_RingLane per consumer and then, for every consumer, `slots`
+    frame slots of `stride` bytes each. Every lane is a single-producer,
+    single-consumer queue: the capturing Context advances `head`, the
+    worker attached to that lane advances `tail`. A worker claims its lane
+    by swapping its pid into `reader`, so each lane has at most one. A frame that finds its
+    lane full is dropped and counted in `drops`, so a slow worker never
+    stalls the capture or the other workers.
+*/
+
+#define PYLORCON2_RING_MAGIC    0x474e524cU  /* "LRNG" */
+#define PYLORCON2_RING_VERSION  2
+#define PYLORCON2_RING_ALIGN    64
+#define PYLORCON2_RING_MAX_SNAPLEN  65535
+
+#define PYLORCON2_FANOUT_HASH   0  /* by hash of addr2 (transmitter) */
+#define PYLORCON2_FANOUT_RR     1  /* round-robin */
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t consumers;
+  uint32_t slots;          /* per consumer, power of two */
+  uint32_t snaplen;
+  uint32_t stride;
+  uint32_t mode;
+  volatile uint32_t closed;
+  volatile int32_t producer; /* pid of the filling process; readers stop if it dies */
+  uint32_t _pad;
+  uint64_t size;
+} PyLorcon2_RingHeader;
+
+typedef struct {
+  volatile uint64_t head;
+  char _pad0[PYLORCON2_RING_ALIGN - sizeof(uint64_t)];
+  volatile uint64_t tail;
+  volatile int32_t reader; /* pid of the attached RingReader, 0 if none */
+  char _pad1[PYLORCON2_RING_ALIGN - sizeof(uint64_t) - sizeof(int32_t)];
+  volatile uint64_t drops;
+  char _pad2[PYLORCON2_RING_ALIGN - sizeof(uint64_t)];
+} PyLorcon2_RingLane;
+
+typedef struct {
+  uint32_t length;         /* length of the frame on the air */
+  uint32_t caplen;         /* bytes stored in data */
+  int64_t tv_sec;
+  int64_t tv_usec;
+  int32_t channel;
+  uint32_t _pad;
+  u_char data[];
+} PyLorcon2_RingSlot;
+
+typedef struct {
+  PyObject_HEAD
+  char *name;
+  PyLorcon2_RingHeader *header;
+  uint32_t next;           /* round-robin cursor, producer side only */
+  uint64_t captured;       /* frames seen by the running fanout() */
+  char capturing;
+} PyLorcon2_Ring;
+
+typedef struct {
+  PyObject_HEAD
+  PyLorcon2_RingHeader *header;
+  uint32_t consumer;
+  int waiting;             /* threads inside read() without the GIL */
+} PyLorcon2_RingReader;
+
+/*
+    Frame fuzzer.
+
+    Mutant number `index` of a Fuzzer is a pure function of its corpus,
+    mutation policy, seed and index, so any (seed, index) pair taken from
+    the injection log regenerates the exact frame that was sent.
+*/
+
+#define PYLORCON2_MUTATE_BITFLIP       0x01
+#define PYLORCON2_MUTATE_IE_LENGTH     0x02
+#define PYLORCON2_MUTATE_IE_VALUE      0x04
+#define PYLORCON2_MUTATE_IE_DUPLICATE  0x08
+#define PYLORCON2_MUTATE_IE_TRUNCATE   0x10
+#define PYLORCON2_MUTATE_FIELD         0x20
+#define PYLORCON2_MUTATE_ALL           0x3f
+
+#define PYLORCON2_FUZZ_MAX_FRAME       4096
+
+typedef struct {
+  uint64_t seed;
+  uint64_t index;
+} PyLorcon2_FuzzLogEntry;
+
+typedef struct {
+  PyObject_HEAD
+  PyLorcon2_Context *context;
+  u_char *corpus;          /* seed frames, back to back */
+  uint32_t *offsets;       /* frame i is corpus[offsets[i]..offsets[i + 1]] */
+  uint32_t frames;
+  uint64_t seed;
+  uint32_t mutations;      /* PYLORCON2_MUTATE_* mask */
+  uint32_t max_mutations;
+  uint64_t index;          /* next mutant to inject */
+  PyLorcon2_FuzzLogEntry *log;
+  uint32_t log_size;
+  uint64_t logged;
+  u_char buffer[PYLORCON2_FUZZ_MAX_FRAME];
+  volatile char stop;
+  char running;
+} PyLorcon2_Fuzzer;
+
 #endif /* __PYLORCON2__ */
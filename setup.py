@@ -20,7 +20,7 @@ from distutils.core import setup, Extension
 
 PyLorcon2 = Extension('PyLorcon2',
                       sources = ['PyLorcon2.c'],
-                      libraries = ['orcon2'])
+                      libraries = ['orcon2', 'rt'])
 
 setup(name = 'PyLorcon2',
       version = '0.3',
@@ -44,4 +44,5 @@ setup(name = 'PyLorcon2',
       author = 'Andres Blanco (6e726d), Ezequiel Gutesman (gutes)',
       author_email = '6e726d@gmail.com, egutesman@gmail.com',
       url = 'http://code.google.com/p/pylorcon2',
+      headers = ['PyLorcon2.h'],
       ext_modules = [PyLorcon2])
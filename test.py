@@ -16,11 +16,27 @@
 #    You should have received a copy of the GNU General Public License
 #    along with PyLorcon2.  If not, see <http://www.gnu.org/licenses/>.
 
+import ctypes
+import struct
 import sys
+import threading
+import time
 import unittest
 
 import PyLorcon2
 
+# Mirror of lorcon_handler and PyLorcon2_CAPI in PyLorcon2.h
+LORCON_HANDLER = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p)
+
+class PyLorcon2_CAPI(ctypes.Structure):
+    _fields_ = [('version', ctypes.c_int),
+                ('ContextType', ctypes.c_void_p),
+                ('Context_AsLorcon', ctypes.PYFUNCTYPE(ctypes.c_void_p, ctypes.py_object)),
+                ('Context_SendBytes', ctypes.CFUNCTYPE(ctypes.c_int, ctypes.py_object,
+                                                       ctypes.c_char_p, ctypes.c_int)),
+                ('Context_SetHandler', ctypes.PYFUNCTYPE(ctypes.c_int, ctypes.py_object,
+                                                         LORCON_HANDLER, ctypes.c_void_p))]
+
 class PyLorcon2TestCase(unittest.TestCase):
     iface = 'wlan0'
     vap = iface
@@ -34,6 +50,8 @@ class PyLorcon2TestCase(unittest.TestCase):
     timeout = 123
     channel = 1
     mac =  (0, 2, 114, 105, 40, 255)
+    ring = '/pylorcon2-test'
+    seed = 1234
 
     def setUp(self):
         self.ctx = PyLorcon2.Context(self.iface)
@@ -41,6 +59,15 @@ class PyLorcon2TestCase(unittest.TestCase):
     def tearDown(self):
         self.ctx.close()
 
+    def transmitter(self, frame):
+        # Skip the RadioTap-header the driver may have put in front
+        if frame[:2] == "\x00\x00" and len(frame) >= 4:
+            frame = frame[struct.unpack("<H", frame[2:4])[0]:]
+        # Only management and data frames are sure to carry an addr2
+        if len(frame) < 24 or ord(frame[0]) & 0x0c not in (0x00, 0x08):
+            return None
+        return frame[10:16]
+
     def testGetVersion(self):
         version = PyLorcon2.get_version()
         self.assertEqual(type(version), int)
@@ -96,6 +123,171 @@ class PyLorcon2TestCase(unittest.TestCase):
         mac = self.ctx.get_hwmac()
         self.assertEqual(self.mac, mac)
 
+    def testRing(self):
+        ring = PyLorcon2.Ring(self.ring, 2, slots=64)
+        reader = PyLorcon2.RingReader(self.ring, 1)
+        self.assertEqual([(0, 0, 0), (0, 0, 0)], ring.stats())
+        self.assertEqual(None, reader.read(timeout=0))
+        self.assertRaises(ValueError, PyLorcon2.RingReader, self.ring, 2)
+        # The timeout is wall-clock time, not the sum of requested naps
+        start = time.time()
+        self.assertEqual(None, reader.read(timeout=200))
+        self.assertTrue(time.time() - start < 0.5)
+        ring.close()
+        self.assertEqual([], list(reader))
+        reader.close()
+
+        # Sizes that would overflow the slot stride or the segment size
+        self.assertRaises(ValueError, PyLorcon2.Ring, self.ring, 21, 2, 0xFFFFFFE0)
+        self.assertRaises(ValueError, PyLorcon2.Ring, self.ring, 1 << 31, 1 << 31, 65535)
+
+    def testFanout(self):
+        self.ctx.open_monitor()
+        for mode in (PyLorcon2.FANOUT_HASH, PyLorcon2.FANOUT_RR):
+            ring = PyLorcon2.Ring(self.ring, 4, slots=64, mode=mode)
+            readers = [PyLorcon2.RingReader(self.ring, i) for i in range(4)]
+            self.assertEqual(32, self.ctx.fanout(ring, 32))
+            stats = ring.stats()
+            self.assertEqual(32, sum([s[0] for s in stats]))
+            self.assertEqual([0] * 4, [s[1] for s in stats])
+            ring.close()
+
+            frames = [list(reader) for reader in readers]
+            self.assertEqual([s[0] for s in stats], [len(f) for f in frames])
+            for reader in readers:
+                self.assertEqual(0, reader.stats()[2])
+                reader.close()
+
+            if mode == PyLorcon2.FANOUT_RR:
+                self.assertEqual([8] * 4, [len(f) for f in frames])
+            else:
+                # Every transmitter must have been sent to a single consumer
+                lanes = {}
+                for i, lane in enumerate(frames):
+                    for frame in lane:
+                        addr2 = self.transmitter(frame)
+                        if addr2 is not None:
+                            self.assertEqual(i, lanes.setdefault(addr2, i))
+
+    def testRingReaderRace(self):
+        self.ctx.open_monitor()
+        ring = PyLorcon2.Ring(self.ring, 1, slots=64)
+        reader = PyLorcon2.RingReader(self.ring, 0)
+        self.assertRaises(RuntimeError, PyLorcon2.RingReader, self.ring, 0)
+
+        frames = []
+        threads = [threading.Thread(target=lambda: frames.append(reader.read(timeout=500)))
+                   for i in range(4)]
+        for thread in threads:
+            thread.start()
+        time.sleep(0.1)
+        self.assertRaises(RuntimeError, reader.close)
+
+        self.assertEqual(1, self.ctx.fanout(ring, 1))
+        for thread in threads:
+            thread.join()
+        self.assertEqual(1, len([f for f in frames if f is not None]))
+        self.assertEqual((1, 0, 0), reader.stats())
+
+        reader.close()
+        ring.close()
+
+    def testFuzzer(self):
+        fuzzer = PyLorcon2.Fuzzer(self.ctx, [self.data], seed=self.seed, log_size=4)
+        other = PyLorcon2.Fuzzer(self.ctx, [self.data], seed=self.seed)
+        for i in range(100):
+            self.assertEqual(fuzzer.generate(i), other.generate(i))
+        self.ctx.open_injmon()
+        self.assertEqual(10, fuzzer.run(10))
+        self.assertEqual(10, fuzzer.get_index())
+        self.assertEqual([(self.seed, i) for i in range(6, 10)], fuzzer.get_log())
+
+    def testFuzzerStop(self):
+        fuzzer = PyLorcon2.Fuzzer(self.ctx, [self.data], seed=self.seed)
+        self.ctx.open_injmon()
+        # One frame every 100 seconds; stop() must not wait for the next one
+        thread = threading.Thread(target=fuzzer.run, kwargs={'rate': 0.01})
+        thread.start()
+        time.sleep(0.2)
+        self.assertRaises(RuntimeError, self.ctx.close)
+        start = time.time()
+        fuzzer.stop()
+        thread.join()
+        self.assertTrue(time.time() - start < 1)
+        self.assertEqual(1, fuzzer.get_index())
+
+        # A stop() that lands before run() starts must still be honoured
+        fuzzer.stop()
+        self.assertEqual(0, fuzzer.run(10))
+        self.assertEqual(1, fuzzer.run(1))
+
+    def testFuzzerMutations(self):
+        count = 500
+        fuzzer = PyLorcon2.Fuzzer(self.ctx, [self.data], seed=self.seed)
+        mutants = [fuzzer.generate(i) for i in range(count)]
+        self.assertTrue(len([m for m in mutants if m != self.data]) > count * 0.95)
+
+        other = PyLorcon2.Fuzzer(self.ctx, [self.data], seed=self.seed + 1)
+        self.assertNotEqual(mutants, [other.generate(i) for i in range(count)])
+
+        def lengths(mutations):
+            fuzzer = PyLorcon2.Fuzzer(self.ctx, [self.data], seed=self.seed,
+                                      mutations=mutations)
+            return set([len(fuzzer.generate(i)) for i in range(count)])
+
+        size = len(self.data)
+        truncated = lengths(PyLorcon2.MUTATE_IE_TRUNCATE)
+        self.assertTrue(max(truncated) <= size and min(truncated) < size)
+        duplicated = lengths(PyLorcon2.MUTATE_IE_DUPLICATE)
+        self.assertTrue(min(duplicated) >= size and max(duplicated) > size)
+        for mutations in (PyLorcon2.MUTATE_BITFLIP, PyLorcon2.MUTATE_FIELD,
+                          PyLorcon2.MUTATE_IE_LENGTH, PyLorcon2.MUTATE_IE_VALUE):
+            self.assertEqual(set([size]), lengths(mutations))
+
+    def testCAPI(self):
+        capsule_name = 'PyLorcon2._C_API'
+        pythonapi = ctypes.pythonapi
+        pythonapi.PyCapsule_IsValid.restype = ctypes.c_int
+        pythonapi.PyCapsule_IsValid.argtypes = [ctypes.py_object, ctypes.c_char_p]
+        pythonapi.PyCapsule_GetPointer.restype = ctypes.c_void_p
+        pythonapi.PyCapsule_GetPointer.argtypes = [ctypes.py_object, ctypes.c_char_p]
+
+        self.assertTrue(pythonapi.PyCapsule_IsValid(PyLorcon2._C_API, capsule_name))
+        api = ctypes.cast(pythonapi.PyCapsule_GetPointer(PyLorcon2._C_API, capsule_name),
+                          ctypes.POINTER(PyLorcon2_CAPI)).contents
+        self.assertEqual(1, api.version)
+        self.assertEqual(id(PyLorcon2.Context), api.ContextType)
+        self.assertTrue(api.Context_AsLorcon(self.ctx))
+
+        # Sending through a context that isn't open must fail
+        self.assertEqual(-1, api.Context_SendBytes(self.ctx, self.data, len(self.data)))
+        self.ctx.open_injmon()
+        self.assertTrue(api.Context_SendBytes(self.ctx, self.data, len(self.data)) >= len(self.data))
+        self.ctx.close()
+        self.assertEqual(-1, api.Context_SendBytes(self.ctx, self.data, len(self.data)))
+
+        self.ctx.open_injmon()
+        # No native handler has been registered through the C API
+        self.assertRaises(RuntimeError, self.ctx.loop, 1)
+
+        # loop() hands every packet to the native handler with its user pointer
+        seen = []
+        handler = LORCON_HANDLER(lambda context, packet, user: seen.append(user))
+        self.assertEqual(0, api.Context_SetHandler(self.ctx, handler, 1234))
+        self.ctx.loop(5)
+        self.assertEqual([1234] * 5, seen)
+
+        # The handler cannot be swapped while loop() is running it
+        slow = LORCON_HANDLER(lambda context, packet, user: time.sleep(0.05))
+        self.assertEqual(0, api.Context_SetHandler(self.ctx, slow, None))
+        looper = threading.Thread(target=self.ctx.loop, args=(10,))
+        looper.start()
+        time.sleep(0.1)
+        self.assertRaises(RuntimeError, api.Context_SetHandler,
+                          self.ctx, LORCON_HANDLER(), None)
+        looper.join()
+        self.assertEqual(0, api.Context_SetHandler(self.ctx, LORCON_HANDLER(), None))
+
 if __name__ == "__main__":
     if len(sys.argv) == 2:
         PyLorcon2TestCase.iface = sys.argv[1]